@@ -0,0 +1,8 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Afterlight.h"
+#include "Modules/ModuleManager.h"
+
+DEFINE_LOG_CATEGORY(LogAfterlight);
+
+IMPLEMENT_PRIMARY_GAME_MODULE(FDefaultGameModuleImpl, Afterlight, "Afterlight");
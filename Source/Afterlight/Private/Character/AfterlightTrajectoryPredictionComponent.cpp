@@ -0,0 +1,232 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Character/AfterlightTrajectoryPredictionComponent.h"
+#include "Engine/World.h"
+#include "GameFramework/Actor.h"
+
+DECLARE_STATS_GROUP(TEXT("Afterlight Trajectory"), STATGROUP_AfterlightTrajectory, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT(TEXT("Prediction (Game Thread)"), STAT_AfterlightTrajectory_GameThread, STATGROUP_AfterlightTrajectory);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Async Traces Submitted"), STAT_AfterlightTrajectory_Traces, STATGROUP_AfterlightTrajectory);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Predictions Submitted"), STAT_AfterlightTrajectory_Predictions, STATGROUP_AfterlightTrajectory);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Cached Predictions Reused"), STAT_AfterlightTrajectory_CacheHits, STATGROUP_AfterlightTrajectory);
+
+UAfterlightTrajectoryPredictionComponent::UAfterlightTrajectoryPredictionComponent()
+{
+	PrimaryComponentTick.bCanEverTick = true;
+	PrimaryComponentTick.bStartWithTickEnabled = false;
+
+	// Submit after the owner has moved this frame so the batch matches what is rendered.
+	PrimaryComponentTick.TickGroup = TG_PostPhysics;
+}
+
+void UAfterlightTrajectoryPredictionComponent::TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction)
+{
+	Super::TickComponent(DeltaTime, TickType, ThisTickFunction);
+
+	SCOPE_CYCLE_COUNTER(STAT_AfterlightTrajectory_GameThread);
+
+	// Async traces run at the end of the frame they were requested in; results are readable one frame later.
+	if (PendingHandles.Num() > 0 && GFrameCounter > PendingFrame)
+	{
+		ConsumeTraces();
+	}
+
+	if (PendingHandles.Num() == 0)
+	{
+		if (NeedsNewPrediction())
+		{
+			SubmitTraces();
+		}
+		else
+		{
+			INC_DWORD_STAT(STAT_AfterlightTrajectory_CacheHits);
+		}
+	}
+}
+
+void UAfterlightTrajectoryPredictionComponent::SetAiming(bool bInAiming)
+{
+	if (bAiming == bInAiming)
+	{
+		return;
+	}
+
+	bAiming = bInAiming;
+	SetComponentTickEnabled(bAiming);
+
+	if (!bAiming)
+	{
+		// Pending results are dropped by the world at the end of the next frame.
+		PendingHandles.Reset();
+		PendingPoints.Reset();
+
+		Prediction.PathPoints.Reset();
+		Prediction.bHit = false;
+		Prediction.Hit.Reset();
+
+		bHasAimInput = false;
+		bPredictionValid = false;
+	}
+}
+
+void UAfterlightTrajectoryPredictionComponent::SetAimInput(const FVector& LaunchLocation, const FVector& LaunchVelocity)
+{
+	AimLocation = LaunchLocation;
+	AimVelocity = LaunchVelocity;
+	bHasAimInput = true;
+}
+
+void UAfterlightTrajectoryPredictionComponent::InvalidatePrediction()
+{
+	bPredictionValid = false;
+}
+
+bool UAfterlightTrajectoryPredictionComponent::NeedsNewPrediction() const
+{
+	if (!bHasAimInput)
+	{
+		return false;
+	}
+
+	if (!bPredictionValid)
+	{
+		return true;
+	}
+
+	const UWorld* World = GetWorld();
+	if (MaxPredictionAge > 0.f && World->GetTimeSeconds() - PredictedTime > MaxPredictionAge)
+	{
+		return true;
+	}
+
+	if (FVector::DistSquared(AimLocation, PredictedLocation) > FMath::Square(LocationTolerance))
+	{
+		return true;
+	}
+
+	if (FMath::Abs(AimVelocity.Size() - PredictedVelocity.Size()) > SpeedTolerance)
+	{
+		return true;
+	}
+
+	const float CosAngleTolerance = FMath::Cos(FMath::DegreesToRadians(AngleTolerance));
+	if (FVector::DotProduct(AimVelocity.GetSafeNormal(), PredictedVelocity.GetSafeNormal()) < CosAngleTolerance)
+	{
+		return true;
+	}
+
+	if (const AActor* Owner = GetOwner())
+	{
+		const FTransform OwnerTransform = Owner->GetActorTransform();
+		if (FVector::DistSquared(OwnerTransform.GetLocation(), PredictedOwnerTransform.GetLocation()) > FMath::Square(LocationTolerance))
+		{
+			return true;
+		}
+
+		if (FMath::RadiansToDegrees(OwnerTransform.GetRotation().AngularDistance(PredictedOwnerTransform.GetRotation())) > AngleTolerance)
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void UAfterlightTrajectoryPredictionComponent::SubmitTraces()
+{
+	UWorld* World = GetWorld();
+	AActor* Owner = GetOwner();
+
+	// The property clamps are editor only; Blueprints can write anything.
+	const int32 SegmentCount = FMath::Clamp(NumSegments, 1, 64);
+	const FVector Gravity(0.f, 0.f, World->GetGravityZ() * GravityScale);
+	const float TimeStep = FMath::Max(MaxSimTime, 0.05f) / SegmentCount;
+
+	PendingPoints.Reset(SegmentCount + 1);
+	for (int32 PointIndex = 0; PointIndex <= SegmentCount; ++PointIndex)
+	{
+		const float Time = PointIndex * TimeStep;
+		PendingPoints.Add(AimLocation + AimVelocity * Time + 0.5f * Gravity * Time * Time);
+	}
+
+	FCollisionQueryParams QueryParams(SCENE_QUERY_STAT(AfterlightTrajectoryPrediction), false, Owner);
+	const FCollisionShape Shape = FCollisionShape::MakeSphere(ProjectileRadius);
+
+	PendingHandles.Reset(SegmentCount);
+	for (int32 SegmentIndex = 0; SegmentIndex < SegmentCount; ++SegmentIndex)
+	{
+		const FVector& Start = PendingPoints[SegmentIndex];
+		const FVector& End = PendingPoints[SegmentIndex + 1];
+
+		if (ProjectileRadius > 0.f)
+		{
+			PendingHandles.Add(World->AsyncSweepByChannel(EAsyncTraceType::Single, Start, End, FQuat::Identity, TraceChannel, Shape, QueryParams));
+		}
+		else
+		{
+			PendingHandles.Add(World->AsyncLineTraceByChannel(EAsyncTraceType::Single, Start, End, TraceChannel, QueryParams));
+		}
+	}
+
+	PendingFrame = GFrameCounter;
+
+	PredictedLocation = AimLocation;
+	PredictedVelocity = AimVelocity;
+	PredictedOwnerTransform = Owner ? Owner->GetActorTransform() : FTransform::Identity;
+	PredictedTime = World->GetTimeSeconds();
+
+	INC_DWORD_STAT_BY(STAT_AfterlightTrajectory_Traces, SegmentCount);
+	INC_DWORD_STAT(STAT_AfterlightTrajectory_Predictions);
+}
+
+bool UAfterlightTrajectoryPredictionComponent::ConsumeTraces()
+{
+	UWorld* World = GetWorld();
+
+	int32 HitSegment = INDEX_NONE;
+	FHitResult Hit;
+
+	FTraceDatum TraceDatum;
+	for (int32 SegmentIndex = 0; SegmentIndex < PendingHandles.Num() && HitSegment == INDEX_NONE; ++SegmentIndex)
+	{
+		if (!World->QueryTraceData(PendingHandles[SegmentIndex], TraceDatum))
+		{
+			// The batch expired, e.g. across a pause or level transition. Resubmit on this tick.
+			PendingHandles.Reset();
+			bPredictionValid = false;
+			return false;
+		}
+
+		for (const FHitResult& TraceHit : TraceDatum.OutHits)
+		{
+			if (TraceHit.bBlockingHit)
+			{
+				HitSegment = SegmentIndex;
+				Hit = TraceHit;
+				break;
+			}
+		}
+	}
+
+	Prediction.PathPoints.Reset();
+	if (HitSegment != INDEX_NONE)
+	{
+		Prediction.PathPoints.Append(PendingPoints.GetData(), HitSegment + 1);
+		Prediction.PathPoints.Add(Hit.Location);
+		Prediction.bHit = true;
+		Prediction.Hit = Hit;
+	}
+	else
+	{
+		Prediction.PathPoints.Append(PendingPoints);
+		Prediction.bHit = false;
+		Prediction.Hit.Reset();
+	}
+
+	PendingHandles.Reset();
+	bPredictionValid = true;
+
+	OnTrajectoryPredicted.Broadcast(Prediction);
+	return true;
+}
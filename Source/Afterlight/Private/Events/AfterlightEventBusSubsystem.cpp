@@ -0,0 +1,312 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Events/AfterlightEventBusSubsystem.h"
+#include "Afterlight.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+
+DECLARE_STATS_GROUP(TEXT("Afterlight Event Bus"), STATGROUP_AfterlightEventBus, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT(TEXT("Dispatch"), STAT_AfterlightEventBus_Dispatch, STATGROUP_AfterlightEventBus);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Events Published"), STAT_AfterlightEventBus_Published, STATGROUP_AfterlightEventBus);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Events Dispatched"), STAT_AfterlightEventBus_Dispatched, STATGROUP_AfterlightEventBus);
+DECLARE_DWORD_COUNTER_STAT(TEXT("Events Dropped"), STAT_AfterlightEventBus_Dropped, STATGROUP_AfterlightEventBus);
+
+void UAfterlightEventBusSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	const int32 Capacity = FMath::RoundUpToPowerOfTwo(FMath::Max(16, QueueCapacity));
+	for (FChannel& Channel : Channels)
+	{
+		Channel.Queue.SetNum(Capacity);
+		Channel.Head = 0;
+		Channel.Num = 0;
+	}
+}
+
+void UAfterlightEventBusSubsystem::PostInitialize()
+{
+	Super::PostInitialize();
+
+	// Tickable objects run before TG_PostUpdateWork, so a plain Tick would not see events published by
+	// late actor and component ticks until the next frame.
+	DispatchTickFunction.EventBus = this;
+	DispatchTickFunction.TickGroup = TG_LastDemotable;
+	DispatchTickFunction.bCanEverTick = true;
+	DispatchTickFunction.bStartWithTickEnabled = true;
+	DispatchTickFunction.bTickEvenWhenPaused = true;
+	DispatchTickFunction.bAllowTickOnDedicatedServer = true;
+	DispatchTickFunction.RegisterTickFunction(GetWorld()->PersistentLevel);
+}
+
+void UAfterlightEventBusSubsystem::Deinitialize()
+{
+	DispatchTickFunction.UnRegisterTickFunction();
+	DispatchTickFunction.EventBus = nullptr;
+
+	for (FChannel& Channel : Channels)
+	{
+		Channel.Queue.Empty();
+		Channel.Head = 0;
+		Channel.Num = 0;
+		Channel.NativeListeners.Clear();
+		Channel.BlueprintListeners.Empty();
+	}
+
+	Super::Deinitialize();
+}
+
+bool UAfterlightEventBusSubsystem::DoesSupportWorldType(const EWorldType::Type WorldType) const
+{
+	return WorldType == EWorldType::Game || WorldType == EWorldType::PIE;
+}
+
+void UAfterlightEventBusSubsystem::AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector)
+{
+	UAfterlightEventBusSubsystem* This = CastChecked<UAfterlightEventBusSubsystem>(InThis);
+
+	// Keep actors referenced by queued events alive until they have been dispatched.
+	for (FChannel& Channel : This->Channels)
+	{
+		const int32 Mask = Channel.Queue.Num() - 1;
+		for (int32 Offset = 0; Offset < Channel.Num; ++Offset)
+		{
+			FAfterlightGameplayEvent& Event = Channel.Queue[(Channel.Head + Offset) & Mask];
+			Collector.AddReferencedObject(Event.Instigator, This);
+			Collector.AddReferencedObject(Event.Target, This);
+		}
+	}
+
+	Super::AddReferencedObjects(InThis, Collector);
+}
+
+bool UAfterlightEventBusSubsystem::Publish(EAfterlightEventChannel ChannelType, const FAfterlightGameplayEvent& Event)
+{
+	// Queues and listener lists are not synchronized.
+	check(IsInGameThread());
+
+	FChannel& Channel = GetChannel(ChannelType);
+
+	const int32 Capacity = Channel.Queue.Num();
+	if (Channel.Num >= Capacity)
+	{
+		++Channel.Stats.Dropped;
+		INC_DWORD_STAT(STAT_AfterlightEventBus_Dropped);
+
+		if (!Channel.bWarnedOverflow)
+		{
+			UE_LOG(LogAfterlight, Warning, TEXT("Event bus channel '%s' is full (%d events); dropping '%s'. Raise QueueCapacity."),
+				*UEnum::GetValueAsString(ChannelType), Capacity, *Event.EventName.ToString());
+			Channel.bWarnedOverflow = true;
+		}
+		return false;
+	}
+
+	FAfterlightGameplayEvent& Slot = Channel.Queue[(Channel.Head + Channel.Num) & (Capacity - 1)];
+	Slot = Event;
+	Slot.Channel = ChannelType;
+	++Channel.Num;
+
+	++Channel.Stats.Published;
+	Channel.Stats.PeakQueueDepth = FMath::Max(Channel.Stats.PeakQueueDepth, Channel.Num);
+	INC_DWORD_STAT(STAT_AfterlightEventBus_Published);
+
+	return true;
+}
+
+void UAfterlightEventBusSubsystem::Subscribe(EAfterlightEventChannel ChannelType, FAfterlightGameplayEventDelegate Listener)
+{
+	check(IsInGameThread());
+
+	if (Listener.IsBound())
+	{
+		GetChannel(ChannelType).BlueprintListeners.AddUnique(Listener);
+	}
+}
+
+void UAfterlightEventBusSubsystem::Unsubscribe(EAfterlightEventChannel ChannelType, FAfterlightGameplayEventDelegate Listener)
+{
+	check(IsInGameThread());
+
+	FChannel& Channel = GetChannel(ChannelType);
+
+	const int32 Index = Channel.BlueprintListeners.IndexOfByKey(Listener);
+	if (Index == INDEX_NONE)
+	{
+		return;
+	}
+
+	if (bDispatching)
+	{
+		// Keep indices stable for the dispatch in progress; compacted once the channel is done.
+		Channel.BlueprintListeners[Index].Unbind();
+		Channel.bHasStaleListeners = true;
+	}
+	else
+	{
+		Channel.BlueprintListeners.RemoveAt(Index);
+	}
+}
+
+void UAfterlightEventBusSubsystem::UnsubscribeAll(const UObject* ListenerObject)
+{
+	check(IsInGameThread());
+
+	for (FChannel& Channel : Channels)
+	{
+		for (int32 Index = Channel.BlueprintListeners.Num() - 1; Index >= 0; --Index)
+		{
+			FAfterlightGameplayEventDelegate& Listener = Channel.BlueprintListeners[Index];
+			if (Listener.GetUObject() != ListenerObject)
+			{
+				continue;
+			}
+
+			if (bDispatching)
+			{
+				Listener.Unbind();
+				Channel.bHasStaleListeners = true;
+			}
+			else
+			{
+				Channel.BlueprintListeners.RemoveAt(Index);
+			}
+		}
+	}
+}
+
+FAfterlightEventChannelStats UAfterlightEventBusSubsystem::GetChannelStats(EAfterlightEventChannel ChannelType) const
+{
+	const FChannel& Channel = GetChannel(ChannelType);
+
+	FAfterlightEventChannelStats Stats = Channel.Stats;
+	Stats.TotalDispatchMicroseconds = static_cast<float>(Channel.TotalDispatchMicroseconds);
+	return Stats;
+}
+
+void UAfterlightEventBusSubsystem::ResetStats()
+{
+	for (FChannel& Channel : Channels)
+	{
+		Channel.Stats = FAfterlightEventChannelStats();
+		Channel.TotalDispatchMicroseconds = 0.0;
+		Channel.bWarnedOverflow = false;
+	}
+}
+
+FAfterlightNativeGameplayEvent& UAfterlightEventBusSubsystem::OnEvent(EAfterlightEventChannel ChannelType)
+{
+	check(IsInGameThread());
+
+	return GetChannel(ChannelType).NativeListeners;
+}
+
+void UAfterlightEventBusSubsystem::DispatchPendingEvents()
+{
+	check(IsInGameThread());
+
+	if (bDispatching)
+	{
+		return;
+	}
+
+	SCOPE_CYCLE_COUNTER(STAT_AfterlightEventBus_Dispatch);
+	TGuardValue<bool> DispatchGuard(bDispatching, true);
+
+	// Only deliver what was queued before dispatch started, so listeners publishing follow-up events
+	// on any channel cannot extend this frame's dispatch.
+	TStaticArray<int32, AfterlightEventChannelCount> QueuedCounts;
+	for (int32 ChannelIndex = 0; ChannelIndex < AfterlightEventChannelCount; ++ChannelIndex)
+	{
+		QueuedCounts[ChannelIndex] = Channels[ChannelIndex].Num;
+	}
+
+	for (int32 ChannelIndex = 0; ChannelIndex < AfterlightEventChannelCount; ++ChannelIndex)
+	{
+		FChannel& Channel = Channels[ChannelIndex];
+		const int32 Count = QueuedCounts[ChannelIndex];
+
+		Channel.Stats.LastDispatchMicroseconds = 0.f;
+		if (Count == 0)
+		{
+			continue;
+		}
+
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		const int32 Mask = Channel.Queue.Num() - 1;
+
+		for (int32 EventIndex = 0; EventIndex < Count; ++EventIndex)
+		{
+			// The slot stays occupied while listeners run, so events they publish cannot overwrite it.
+			FAfterlightGameplayEvent& Event = Channel.Queue[Channel.Head];
+
+			Channel.NativeListeners.Broadcast(Event);
+
+			// Listeners subscribed during dispatch start receiving events from the next one.
+			const int32 NumListeners = Channel.BlueprintListeners.Num();
+			for (int32 ListenerIndex = 0; ListenerIndex < NumListeners; ++ListenerIndex)
+			{
+				// Copy the delegate; a listener subscribing from inside the callback may grow the array.
+				const FAfterlightGameplayEventDelegate Listener = Channel.BlueprintListeners[ListenerIndex];
+				if (Listener.IsBound())
+				{
+					Listener.Execute(Event);
+				}
+				else
+				{
+					Channel.bHasStaleListeners = true;
+				}
+			}
+
+			Event.Instigator = nullptr;
+			Event.Target = nullptr;
+
+			Channel.Head = (Channel.Head + 1) & Mask;
+			--Channel.Num;
+		}
+
+		if (Channel.bHasStaleListeners)
+		{
+			Channel.BlueprintListeners.RemoveAll([](const FAfterlightGameplayEventDelegate& Listener) { return !Listener.IsBound(); });
+			Channel.bHasStaleListeners = false;
+		}
+
+		const double Microseconds = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1000.0;
+		Channel.Stats.Dispatched += Count;
+		Channel.Stats.LastDispatchMicroseconds = static_cast<float>(Microseconds);
+		Channel.TotalDispatchMicroseconds += Microseconds;
+
+		INC_DWORD_STAT_BY(STAT_AfterlightEventBus_Dispatched, Count);
+	}
+}
+
+void UAfterlightEventBusSubsystem::FDispatchTickFunction::ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent)
+{
+	if (EventBus)
+	{
+		EventBus->DispatchPendingEvents();
+	}
+}
+
+FString UAfterlightEventBusSubsystem::FDispatchTickFunction::DiagnosticMessage()
+{
+	return TEXT("UAfterlightEventBusSubsystem::DispatchTickFunction");
+}
+
+FName UAfterlightEventBusSubsystem::FDispatchTickFunction::DiagnosticContext(bool bDetailed)
+{
+	return FName(TEXT("AfterlightEventBus"));
+}
+
+UAfterlightEventBusSubsystem::FChannel& UAfterlightEventBusSubsystem::GetChannel(EAfterlightEventChannel Channel)
+{
+	check(Channel < EAfterlightEventChannel::Count);
+	return Channels[static_cast<int32>(Channel)];
+}
+
+const UAfterlightEventBusSubsystem::FChannel& UAfterlightEventBusSubsystem::GetChannel(EAfterlightEventChannel Channel) const
+{
+	check(Channel < EAfterlightEventChannel::Count);
+	return Channels[static_cast<int32>(Channel)];
+}
@@ -0,0 +1,220 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Save/AfterlightCheckpointSubsystem.h"
+#include "Save/AfterlightCheckpointWriter.h"
+#include "Afterlight.h"
+#include "Misc/Paths.h"
+
+DECLARE_CYCLE_STAT(TEXT("Snapshot (Game Thread)"), STAT_AfterlightCheckpoint_Snapshot, STATGROUP_AfterlightCheckpoint);
+DECLARE_CYCLE_STAT(TEXT("Load"), STAT_AfterlightCheckpoint_Load, STATGROUP_AfterlightCheckpoint);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Records Snapshotted"), STAT_AfterlightCheckpoint_Records, STATGROUP_AfterlightCheckpoint);
+
+void UAfterlightCheckpointSubsystem::Initialize(FSubsystemCollectionBase& Collection)
+{
+	Super::Initialize(Collection);
+
+	Writer = MakeShared<FAfterlightCheckpointWriter>(GetSlotDirectory(), CompactionInterval);
+
+	if (bLoadOnInitialize)
+	{
+		LoadCheckpoint();
+	}
+}
+
+void UAfterlightCheckpointSubsystem::Deinitialize()
+{
+	// Destroying the writer waits for every queued delta.
+	Writer.Reset();
+
+	Super::Deinitialize();
+}
+
+void UAfterlightCheckpointSubsystem::SetState(EAfterlightCheckpointDomain Domain, FName Key, int32 Value)
+{
+	FDomainState& State = GetDomain(Domain);
+
+	int32* ExistingValue = State.Values.Find(Key);
+	if (ExistingValue && *ExistingValue == Value)
+	{
+		return;
+	}
+
+	if (ExistingValue)
+	{
+		*ExistingValue = Value;
+	}
+	else
+	{
+		State.Values.Add(Key, Value);
+	}
+	State.DirtyKeys.Add(Key);
+}
+
+void UAfterlightCheckpointSubsystem::ClearState(EAfterlightCheckpointDomain Domain, FName Key)
+{
+	FDomainState& State = GetDomain(Domain);
+	if (State.Values.Remove(Key) > 0)
+	{
+		State.DirtyKeys.Add(Key);
+	}
+}
+
+int32 UAfterlightCheckpointSubsystem::GetState(EAfterlightCheckpointDomain Domain, FName Key, int32 DefaultValue) const
+{
+	const int32* Value = GetDomain(Domain).Values.Find(Key);
+	return Value ? *Value : DefaultValue;
+}
+
+bool UAfterlightCheckpointSubsystem::HasState(EAfterlightCheckpointDomain Domain, FName Key) const
+{
+	return GetDomain(Domain).Values.Contains(Key);
+}
+
+bool UAfterlightCheckpointSubsystem::SaveCheckpoint()
+{
+	SCOPE_CYCLE_COUNTER(STAT_AfterlightCheckpoint_Snapshot);
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	int32 NumDirty = 0;
+	for (const FDomainState& State : Domains)
+	{
+		NumDirty += State.DirtyKeys.Num();
+	}
+
+	if (NumDirty == 0 || !Writer)
+	{
+		LastSnapshotMicroseconds = 0.f;
+		return false;
+	}
+
+	TArray<FAfterlightCheckpointRecord> Records;
+	Records.Reserve(NumDirty);
+
+	for (int32 DomainIndex = 0; DomainIndex < AfterlightCheckpointDomainCount; ++DomainIndex)
+	{
+		FDomainState& State = Domains[DomainIndex];
+		for (const FName& Key : State.DirtyKeys)
+		{
+			FAfterlightCheckpointRecord& Record = Records.AddDefaulted_GetRef();
+			Record.Domain = static_cast<EAfterlightCheckpointDomain>(DomainIndex);
+			Record.Key = Key;
+
+			if (const int32* Value = State.Values.Find(Key))
+			{
+				Record.Value = *Value;
+			}
+			else
+			{
+				Record.bRemoved = true;
+			}
+		}
+
+		// Keep the allocation so the next checkpoint does not rehash.
+		State.DirtyKeys.Reset();
+	}
+
+	Writer->EnqueueDelta(MoveTemp(Records));
+
+	INC_DWORD_STAT_BY(STAT_AfterlightCheckpoint_Records, NumDirty);
+	LastSnapshotMicroseconds = static_cast<float>(FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1000.0);
+
+	return true;
+}
+
+bool UAfterlightCheckpointSubsystem::LoadCheckpoint()
+{
+	SCOPE_CYCLE_COUNTER(STAT_AfterlightCheckpoint_Load);
+
+	if (!Writer)
+	{
+		return false;
+	}
+
+	Writer->Flush();
+
+	FAfterlightCheckpointState LoadedState;
+	uint32 Sequence = 0;
+	const bool bLoaded = FAfterlightCheckpointWriter::ReadSlot(GetSlotDirectory(), LoadedState, Sequence);
+
+	for (int32 DomainIndex = 0; DomainIndex < AfterlightCheckpointDomainCount; ++DomainIndex)
+	{
+		Domains[DomainIndex].Values = LoadedState[DomainIndex];
+		Domains[DomainIndex].DirtyKeys.Reset();
+	}
+
+	Writer->Reset(LoadedState, Sequence);
+
+	if (bLoaded)
+	{
+		UE_LOG(LogAfterlight, Log, TEXT("Loaded checkpoint slot '%s' at sequence %u"), *SlotName, Sequence);
+	}
+
+	return bLoaded;
+}
+
+bool UAfterlightCheckpointSubsystem::OpenSlot(const FString& InSlotName)
+{
+	// Destroying the writer waits for every queued delta of the old slot.
+	Writer.Reset();
+
+	SlotName = InSlotName;
+	Writer = MakeShared<FAfterlightCheckpointWriter>(GetSlotDirectory(), CompactionInterval);
+
+	return LoadCheckpoint();
+}
+
+void UAfterlightCheckpointSubsystem::ResetProgress()
+{
+	for (FDomainState& State : Domains)
+	{
+		State.Values.Reset();
+		State.DirtyKeys.Reset();
+	}
+
+	if (Writer)
+	{
+		Writer->EnqueueClear();
+	}
+}
+
+void UAfterlightCheckpointSubsystem::FlushCheckpointWrites()
+{
+	if (Writer)
+	{
+		Writer->Flush();
+	}
+}
+
+bool UAfterlightCheckpointSubsystem::HasUnsavedChanges() const
+{
+	for (const FDomainState& State : Domains)
+	{
+		if (State.DirtyKeys.Num() > 0)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+bool UAfterlightCheckpointSubsystem::IsWriteInProgress() const
+{
+	return Writer && Writer->GetPendingWrites() > 0;
+}
+
+FString UAfterlightCheckpointSubsystem::GetSlotDirectory() const
+{
+	return FPaths::ProjectSavedDir() / TEXT("SaveGames") / SlotName;
+}
+
+UAfterlightCheckpointSubsystem::FDomainState& UAfterlightCheckpointSubsystem::GetDomain(EAfterlightCheckpointDomain Domain)
+{
+	check(Domain < EAfterlightCheckpointDomain::Count);
+	return Domains[static_cast<int32>(Domain)];
+}
+
+const UAfterlightCheckpointSubsystem::FDomainState& UAfterlightCheckpointSubsystem::GetDomain(EAfterlightCheckpointDomain Domain) const
+{
+	check(Domain < EAfterlightCheckpointDomain::Count);
+	return Domains[static_cast<int32>(Domain)];
+}
@@ -0,0 +1,458 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Save/AfterlightCheckpointWriter.h"
+#include "Afterlight.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Compression.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+DECLARE_CYCLE_STAT(TEXT("Write Delta"), STAT_AfterlightCheckpoint_WriteDelta, STATGROUP_AfterlightCheckpoint);
+DECLARE_CYCLE_STAT(TEXT("Write Base"), STAT_AfterlightCheckpoint_WriteBase, STATGROUP_AfterlightCheckpoint);
+DECLARE_DWORD_ACCUMULATOR_STAT(TEXT("Bytes Written"), STAT_AfterlightCheckpoint_BytesWritten, STATGROUP_AfterlightCheckpoint);
+
+namespace AfterlightCheckpoint
+{
+	static constexpr uint32 Magic = 0x50434C41; // "ALCP"
+	static constexpr uint32 Version = 1;
+
+	static constexpr uint8 KindBase = 0;
+	static constexpr uint8 KindDelta = 1;
+
+	static constexpr uint8 RemovedFlag = 0x80;
+
+	/** Domain byte plus the smallest possible key. Bounds the record count a payload can claim. */
+	static constexpr int32 MinEncodedRecordSize = 5;
+
+	/** Largest payload a file may claim, far above any real checkpoint. Rejects damaged size fields. */
+	static constexpr int32 MaxPayloadSize = 64 * 1024 * 1024;
+
+	static const TCHAR* BaseWildcard = TEXT("Base_*.ckpt");
+	static const TCHAR* DeltaWildcard = TEXT("Delta_*.ckpt");
+	static const TCHAR* TempWildcard = TEXT("*.tmp");
+
+	static FString GetBaseFileName(uint32 Sequence)
+	{
+		return FString::Printf(TEXT("Base_%08u.ckpt"), Sequence);
+	}
+
+	static FString GetDeltaFileName(uint32 Sequence)
+	{
+		return FString::Printf(TEXT("Delta_%08u.ckpt"), Sequence);
+	}
+
+	/** Lists files matching Wildcard in Directory, oldest sequence first. */
+	static TArray<FString> FindSequencedFiles(const FString& Directory, const TCHAR* Wildcard)
+	{
+		TArray<FString> Files;
+		IFileManager::Get().FindFiles(Files, *(Directory / Wildcard), true, false);
+
+		// Zero-padded sequence numbers make the names sort in write order.
+		Files.Sort();
+		return Files;
+	}
+
+	struct FFileHeader
+	{
+		uint32 Magic = 0;
+		uint32 Version = 0;
+		uint8 Kind = 0;
+		uint32 Sequence = 0;
+		int32 UncompressedSize = 0;
+		/** Zero when the payload was stored uncompressed. */
+		int32 CompressedSize = 0;
+
+		friend FArchive& operator<<(FArchive& Ar, FFileHeader& Header)
+		{
+			return Ar << Header.Magic << Header.Version << Header.Kind << Header.Sequence << Header.UncompressedSize << Header.CompressedSize;
+		}
+	};
+
+	static TArray<uint8> SerializeRecords(const TArray<FAfterlightCheckpointRecord>& Records)
+	{
+		TArray<uint8> Payload;
+		FMemoryWriter Writer(Payload);
+
+		int32 NumRecords = Records.Num();
+		Writer << NumRecords;
+		for (const FAfterlightCheckpointRecord& Record : Records)
+		{
+			uint8 DomainAndFlags = static_cast<uint8>(Record.Domain) | (Record.bRemoved ? RemovedFlag : 0);
+			FName Key = Record.Key;
+			Writer << DomainAndFlags;
+			Writer << Key;
+			if (!Record.bRemoved)
+			{
+				int32 Value = Record.Value;
+				Writer << Value;
+			}
+		}
+
+		return Payload;
+	}
+
+	static bool DeserializeRecords(const TArray<uint8>& Payload, TArray<FAfterlightCheckpointRecord>& OutRecords)
+	{
+		FMemoryReader Reader(Payload);
+
+		int32 NumRecords = 0;
+		Reader << NumRecords;
+		if (NumRecords < 0 || NumRecords > Payload.Num() / MinEncodedRecordSize || Reader.IsError())
+		{
+			return false;
+		}
+
+		OutRecords.Reset(NumRecords);
+		for (int32 Index = 0; Index < NumRecords && !Reader.IsError(); ++Index)
+		{
+			uint8 DomainAndFlags = 0;
+			Reader << DomainAndFlags;
+
+			FAfterlightCheckpointRecord& Record = OutRecords.AddDefaulted_GetRef();
+			Record.bRemoved = (DomainAndFlags & RemovedFlag) != 0;
+			Record.Domain = static_cast<EAfterlightCheckpointDomain>(DomainAndFlags & ~RemovedFlag);
+			Reader << Record.Key;
+			if (!Record.bRemoved)
+			{
+				Reader << Record.Value;
+			}
+
+			if (static_cast<int32>(Record.Domain) >= AfterlightCheckpointDomainCount)
+			{
+				return false;
+			}
+		}
+
+		return !Reader.IsError();
+	}
+
+	static bool ReadFile(const FString& Path, FFileHeader& OutHeader, TArray<FAfterlightCheckpointRecord>& OutRecords)
+	{
+		TArray<uint8> Bytes;
+		if (!FFileHelper::LoadFileToArray(Bytes, *Path, FILEREAD_Silent))
+		{
+			return false;
+		}
+
+		FMemoryReader Reader(Bytes);
+		Reader << OutHeader;
+		if (Reader.IsError() || OutHeader.Magic != Magic || OutHeader.Version != Version
+			|| OutHeader.UncompressedSize < 0 || OutHeader.UncompressedSize > MaxPayloadSize || OutHeader.CompressedSize < 0)
+		{
+			UE_LOG(LogAfterlight, Warning, TEXT("Checkpoint file '%s' has an invalid header"), *Path);
+			return false;
+		}
+
+		const int64 DataOffset = Reader.Tell();
+		const int64 DataSize = Bytes.Num() - DataOffset;
+
+		TArray<uint8> Payload;
+		if (OutHeader.CompressedSize > 0)
+		{
+			if (DataSize < OutHeader.CompressedSize)
+			{
+				UE_LOG(LogAfterlight, Warning, TEXT("Checkpoint file '%s' is truncated"), *Path);
+				return false;
+			}
+
+			Payload.SetNumUninitialized(OutHeader.UncompressedSize);
+			if (!FCompression::UncompressMemory(NAME_Oodle, Payload.GetData(), OutHeader.UncompressedSize, Bytes.GetData() + DataOffset, OutHeader.CompressedSize))
+			{
+				UE_LOG(LogAfterlight, Warning, TEXT("Checkpoint file '%s' failed to decompress"), *Path);
+				return false;
+			}
+		}
+		else
+		{
+			if (DataSize < OutHeader.UncompressedSize)
+			{
+				UE_LOG(LogAfterlight, Warning, TEXT("Checkpoint file '%s' is truncated"), *Path);
+				return false;
+			}
+
+			Payload.Append(Bytes.GetData() + DataOffset, OutHeader.UncompressedSize);
+		}
+
+		if (!DeserializeRecords(Payload, OutRecords))
+		{
+			UE_LOG(LogAfterlight, Warning, TEXT("Checkpoint file '%s' has a corrupt payload"), *Path);
+			return false;
+		}
+
+		return true;
+	}
+
+	static void ApplyRecords(FAfterlightCheckpointState& State, const TArray<FAfterlightCheckpointRecord>& Records)
+	{
+		for (const FAfterlightCheckpointRecord& Record : Records)
+		{
+			TMap<FName, int32>& Values = State[static_cast<int32>(Record.Domain)];
+			if (Record.bRemoved)
+			{
+				Values.Remove(Record.Key);
+			}
+			else
+			{
+				Values.Add(Record.Key, Record.Value);
+			}
+		}
+	}
+}
+
+FAfterlightCheckpointWriter::FAfterlightCheckpointWriter(const FString& InDirectory, int32 InCompactionInterval)
+	: Directory(InDirectory)
+	, CompactionInterval(FMath::Max(1, InCompactionInterval))
+	, Pipe(TEXT("AfterlightCheckpointWriter"))
+{
+}
+
+FAfterlightCheckpointWriter::~FAfterlightCheckpointWriter()
+{
+	Flush();
+}
+
+bool FAfterlightCheckpointWriter::ReadSlot(const FString& Directory, FAfterlightCheckpointState& OutState, uint32& OutSequence)
+{
+	using namespace AfterlightCheckpoint;
+
+	for (TMap<FName, int32>& Values : OutState)
+	{
+		Values.Reset();
+	}
+	OutSequence = 0;
+
+	bool bFoundAny = false;
+
+	FFileHeader Header;
+	TArray<FAfterlightCheckpointRecord> Records;
+
+	// Older bases only survive if the newest one was written but pruning did not finish, so the newest
+	// base that reads back cleanly is the starting point.
+	TArray<FString> BaseFiles = FindSequencedFiles(Directory, BaseWildcard);
+	for (int32 Index = BaseFiles.Num() - 1; Index >= 0; --Index)
+	{
+		if (ReadFile(Directory / BaseFiles[Index], Header, Records) && Header.Kind == KindBase)
+		{
+			ApplyRecords(OutState, Records);
+			OutSequence = Header.Sequence;
+			bFoundAny = true;
+			break;
+		}
+	}
+
+	for (const FString& DeltaFile : FindSequencedFiles(Directory, DeltaWildcard))
+	{
+		if (!ReadFile(Directory / DeltaFile, Header, Records) || Header.Kind != KindDelta)
+		{
+			continue;
+		}
+
+		// Deltas already folded into the base are left behind if a compaction was interrupted.
+		if (Header.Sequence <= OutSequence)
+		{
+			continue;
+		}
+
+		ApplyRecords(OutState, Records);
+		OutSequence = Header.Sequence;
+		bFoundAny = true;
+	}
+
+	return bFoundAny;
+}
+
+void FAfterlightCheckpointWriter::Reset(const FAfterlightCheckpointState& InState, uint32 InSequence)
+{
+	check(IsInGameThread());
+	check(!Pipe.HasWork());
+
+	Mirror = InState;
+	NextSequence = InSequence + 1;
+	DeltasSinceBase = 0;
+}
+
+void FAfterlightCheckpointWriter::EnqueueDelta(TArray<FAfterlightCheckpointRecord>&& Records)
+{
+	check(IsInGameThread());
+
+	const uint32 Sequence = NextSequence++;
+	PendingWrites.fetch_add(1, std::memory_order_relaxed);
+
+	Pipe.Launch(TEXT("AfterlightCheckpointWriteDelta"), [this, Sequence, Records = MoveTemp(Records)]()
+	{
+		if (WriteDelta(Sequence, Records))
+		{
+			++DeltasSinceBase;
+		}
+		else
+		{
+			// The mirror already holds the change but the chain on disk now has a gap. Only a base
+			// covers it, so keep forcing one until a base write succeeds.
+			DeltasSinceBase = CompactionInterval;
+		}
+
+		if (DeltasSinceBase >= CompactionInterval && WriteBase(Sequence))
+		{
+			DeltasSinceBase = 0;
+		}
+
+		PendingWrites.fetch_sub(1, std::memory_order_relaxed);
+	}, UE::Tasks::ETaskPriority::BackgroundNormal);
+}
+
+void FAfterlightCheckpointWriter::EnqueueClear()
+{
+	check(IsInGameThread());
+
+	PendingWrites.fetch_add(1, std::memory_order_relaxed);
+
+	Pipe.Launch(TEXT("AfterlightCheckpointClear"), [this]()
+	{
+		for (TMap<FName, int32>& Values : Mirror)
+		{
+			Values.Reset();
+		}
+		DeltasSinceBase = 0;
+
+		IFileManager::Get().DeleteDirectory(*Directory, false, true);
+
+		PendingWrites.fetch_sub(1, std::memory_order_relaxed);
+	}, UE::Tasks::ETaskPriority::BackgroundNormal);
+}
+
+void FAfterlightCheckpointWriter::Flush()
+{
+	Pipe.WaitUntilEmpty();
+}
+
+bool FAfterlightCheckpointWriter::WriteDelta(uint32 Sequence, const TArray<FAfterlightCheckpointRecord>& Records)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AfterlightCheckpoint_WriteDelta);
+
+	AfterlightCheckpoint::ApplyRecords(Mirror, Records);
+
+	const TArray<uint8> Payload = AfterlightCheckpoint::SerializeRecords(Records);
+
+	return WriteFileAtomic(Directory / AfterlightCheckpoint::GetDeltaFileName(Sequence), AfterlightCheckpoint::KindDelta, Sequence, Payload);
+}
+
+bool FAfterlightCheckpointWriter::WriteBase(uint32 Sequence)
+{
+	SCOPE_CYCLE_COUNTER(STAT_AfterlightCheckpoint_WriteBase);
+
+	TArray<FAfterlightCheckpointRecord> Records;
+	for (int32 DomainIndex = 0; DomainIndex < AfterlightCheckpointDomainCount; ++DomainIndex)
+	{
+		for (const TPair<FName, int32>& Pair : Mirror[DomainIndex])
+		{
+			FAfterlightCheckpointRecord& Record = Records.AddDefaulted_GetRef();
+			Record.Domain = static_cast<EAfterlightCheckpointDomain>(DomainIndex);
+			Record.Key = Pair.Key;
+			Record.Value = Pair.Value;
+		}
+	}
+
+	const TArray<uint8> Payload = AfterlightCheckpoint::SerializeRecords(Records);
+	if (!WriteFileAtomic(Directory / AfterlightCheckpoint::GetBaseFileName(Sequence), AfterlightCheckpoint::KindBase, Sequence, Payload))
+	{
+		// Keep the previous base and its deltas; they are still needed to rebuild the state.
+		return false;
+	}
+
+	// The new base is in place under its own name, so everything it covers can go. A crash while
+	// pruning only leaves files that ReadSlot skips.
+	IFileManager& FileManager = IFileManager::Get();
+	for (const FString& BaseFile : AfterlightCheckpoint::FindSequencedFiles(Directory, AfterlightCheckpoint::BaseWildcard))
+	{
+		uint32 BaseSequence = 0;
+		if (FParse::Value(*BaseFile, TEXT("Base_"), BaseSequence) && BaseSequence < Sequence)
+		{
+			FileManager.Delete(*(Directory / BaseFile), false, false, true);
+		}
+	}
+
+	for (const FString& DeltaFile : AfterlightCheckpoint::FindSequencedFiles(Directory, AfterlightCheckpoint::DeltaWildcard))
+	{
+		uint32 DeltaSequence = 0;
+		if (FParse::Value(*DeltaFile, TEXT("Delta_"), DeltaSequence) && DeltaSequence <= Sequence)
+		{
+			FileManager.Delete(*(Directory / DeltaFile), false, false, true);
+		}
+	}
+
+	// Temporary files left by a crash mid-write.
+	for (const FString& TempFile : AfterlightCheckpoint::FindSequencedFiles(Directory, AfterlightCheckpoint::TempWildcard))
+	{
+		FileManager.Delete(*(Directory / TempFile), false, false, true);
+	}
+
+	return true;
+}
+
+bool FAfterlightCheckpointWriter::WriteFileAtomic(const FString& FinalPath, uint8 Kind, uint32 Sequence, const TArray<uint8>& Payload) const
+{
+	using namespace AfterlightCheckpoint;
+
+	FFileHeader Header;
+	Header.Magic = Magic;
+	Header.Version = Version;
+	Header.Kind = Kind;
+	Header.Sequence = Sequence;
+	Header.UncompressedSize = Payload.Num();
+
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+	Writer << Header;
+	const int32 DataOffset = Bytes.Num();
+
+	int32 CompressedSize = static_cast<int32>(FCompression::CompressMemoryBound(NAME_Oodle, Payload.Num()));
+	Bytes.SetNumUninitialized(DataOffset + CompressedSize);
+	if (FCompression::CompressMemory(NAME_Oodle, Bytes.GetData() + DataOffset, CompressedSize, Payload.GetData(), Payload.Num(), COMPRESS_BiasSpeed)
+		&& CompressedSize < Payload.Num())
+	{
+		Header.CompressedSize = CompressedSize;
+		Bytes.SetNum(DataOffset + CompressedSize);
+	}
+	else
+	{
+		// Tiny deltas do not compress; store them as-is.
+		Header.CompressedSize = 0;
+		Bytes.SetNum(DataOffset);
+		Bytes.Append(Payload);
+	}
+
+	// Rewrite the header now that the compressed size is known.
+	Writer.Seek(0);
+	Writer << Header;
+
+	// WriteBase deletes the files a new base replaces as soon as this returns, so the data has to be on
+	// the disk, not just in the OS cache, before the rename makes it visible.
+	const FString TempPath = FinalPath + TEXT(".tmp");
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*Directory);
+	{
+		TUniquePtr<IFileHandle> File(PlatformFile.OpenWrite(*TempPath));
+		if (!File || !File->Write(Bytes.GetData(), Bytes.Num()) || !File->Flush(true))
+		{
+			UE_LOG(LogAfterlight, Error, TEXT("Failed to write checkpoint file '%s'"), *TempPath);
+			File.Reset();
+			PlatformFile.DeleteFile(*TempPath);
+			return false;
+		}
+	}
+
+	// Final names carry a fresh sequence number, so this is a plain rename rather than a delete followed
+	// by a rename. Replace is only allowed so a corrupt leftover with the same name cannot block the write.
+	if (!IFileManager::Get().Move(*FinalPath, *TempPath, true, true))
+	{
+		UE_LOG(LogAfterlight, Error, TEXT("Failed to move checkpoint file into place at '%s'"), *FinalPath);
+		IFileManager::Get().Delete(*TempPath, false, false, true);
+		return false;
+	}
+
+	INC_DWORD_STAT_BY(STAT_AfterlightCheckpoint_BytesWritten, Bytes.Num());
+	return true;
+}
@@ -0,0 +1,70 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Save/AfterlightCheckpointTypes.h"
+#include "Tasks/Pipe.h"
+
+DECLARE_STATS_GROUP(TEXT("Afterlight Checkpoint"), STATGROUP_AfterlightCheckpoint, STATCAT_Advanced);
+
+/**
+ * Owns the on-disk checkpoint slot.
+ *
+ * A slot is one compressed base file plus a chain of compressed delta files, all named after their
+ * sequence number. Deltas are handed over from the game thread and serialized, compressed and written
+ * in order on a background pipe. Every file is written to a temporary name, flushed to disk and renamed
+ * to its final, not yet existing name, so neither a crash nor a power loss leaves a torn file behind
+ * under a final name. After CompactionInterval deltas the worker folds its mirror of the state into a
+ * new base, and only once that base is on disk deletes the older bases and deltas it covers.
+ */
+class FAfterlightCheckpointWriter
+{
+public:
+	FAfterlightCheckpointWriter(const FString& InDirectory, int32 InCompactionInterval);
+	~FAfterlightCheckpointWriter();
+
+	/**
+	 * Reads the newest valid base file and every newer delta of a slot.
+	 *
+	 * @param Directory		slot directory
+	 * @param OutState		merged state of every domain
+	 * @param OutSequence	sequence number of the newest file that was applied
+	 * @return false if the slot has no readable base or delta
+	 */
+	static bool ReadSlot(const FString& Directory, FAfterlightCheckpointState& OutState, uint32& OutSequence);
+
+	/** Seeds the worker mirror after a load. Must be called while no write is in flight. */
+	void Reset(const FAfterlightCheckpointState& InState, uint32 InSequence);
+
+	/** Queues a delta for background serialization. Game thread only. */
+	void EnqueueDelta(TArray<FAfterlightCheckpointRecord>&& Records);
+
+	/** Queues deletion of every file in the slot and clears the mirror. Game thread only. */
+	void EnqueueClear();
+
+	/** Blocks until every queued delta is on disk. */
+	void Flush();
+
+	/** Number of deltas queued but not yet written. */
+	int32 GetPendingWrites() const { return PendingWrites.load(std::memory_order_relaxed); }
+
+private:
+	bool WriteDelta(uint32 Sequence, const TArray<FAfterlightCheckpointRecord>& Records);
+	bool WriteBase(uint32 Sequence);
+	bool WriteFileAtomic(const FString& FinalPath, uint8 Kind, uint32 Sequence, const TArray<uint8>& Payload) const;
+
+	FString Directory;
+	int32 CompactionInterval;
+
+	UE::Tasks::FPipe Pipe;
+
+	/** Next sequence number to hand out. Game thread only. */
+	uint32 NextSequence = 1;
+
+	/** Latest on-disk state. Only touched from tasks running on Pipe, or while Pipe is empty. */
+	FAfterlightCheckpointState Mirror;
+	int32 DeltasSinceBase = 0;
+
+	std::atomic<int32> PendingWrites = 0;
+};
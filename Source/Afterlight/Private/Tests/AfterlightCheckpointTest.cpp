@@ -0,0 +1,137 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Save/AfterlightCheckpointSubsystem.h"
+#include "Engine/GameInstance.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/Paths.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace AfterlightCheckpointTest
+{
+	static const TCHAR* SlotName = TEXT("AutomationTest_Checkpoint");
+
+	/** Keys dirtied in every domain before the timed checkpoint. */
+	static constexpr int32 KeysPerDomain = 64;
+
+	/** Timed checkpoints; the fastest one is compared against the budget to ignore scheduling noise. */
+	static constexpr int32 NumTimedRuns = 5;
+
+	/** Generous game thread budget for snapshotting KeysPerDomain keys in every domain, Debug included. */
+	static constexpr double SnapshotBudgetMicroseconds = 1000.0;
+
+	static constexpr int32 CompactionInterval = 4;
+
+	static FName MakeKey(int32 Index)
+	{
+		return FName(TEXT("Key"), Index + 1);
+	}
+
+	static int32 MakeValue(int32 DomainIndex, int32 Index)
+	{
+		return DomainIndex * 1000 + Index;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FAfterlightCheckpointSaveLoadTest, "Afterlight.Save.Checkpoint.SaveLoad",
+	EAutomationTestFlags_ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FAfterlightCheckpointSaveLoadTest::RunTest(const FString& Parameters)
+{
+	using namespace AfterlightCheckpointTest;
+
+	// Game instance subsystems must live inside a game instance; neither needs to be initialized here.
+	UGameInstance* GameInstance = NewObject<UGameInstance>(GetTransientPackage());
+	UAfterlightCheckpointSubsystem* Checkpoint = NewObject<UAfterlightCheckpointSubsystem>(GameInstance);
+	Checkpoint->CompactionInterval = CompactionInterval;
+
+	// Start from an empty slot of our own so player saves are never touched.
+	Checkpoint->OpenSlot(SlotName);
+	Checkpoint->ResetProgress();
+	Checkpoint->FlushCheckpointWrites();
+
+	// Dirty every domain and time the game thread snapshot. The last run writes the values checked below.
+	double BestSnapshotMicroseconds = TNumericLimits<double>::Max();
+	for (int32 Run = 0; Run < NumTimedRuns; ++Run)
+	{
+		const int32 RunOffset = NumTimedRuns - 1 - Run;
+		for (int32 DomainIndex = 0; DomainIndex < AfterlightCheckpointDomainCount; ++DomainIndex)
+		{
+			for (int32 Index = 0; Index < KeysPerDomain; ++Index)
+			{
+				Checkpoint->SetState(static_cast<EAfterlightCheckpointDomain>(DomainIndex), MakeKey(Index), MakeValue(DomainIndex, Index) + RunOffset);
+			}
+		}
+
+		const uint64 StartCycles = FPlatformTime::Cycles64();
+		const bool bSaved = Checkpoint->SaveCheckpoint();
+		const double SnapshotMicroseconds = FPlatformTime::ToMilliseconds64(FPlatformTime::Cycles64() - StartCycles) * 1000.0;
+		BestSnapshotMicroseconds = FMath::Min(BestSnapshotMicroseconds, SnapshotMicroseconds);
+
+		TestTrue(TEXT("Checkpoint with dirty keys is queued"), bSaved);
+		TestFalse(TEXT("Snapshot clears the dirty keys"), Checkpoint->HasUnsavedChanges());
+		AddInfo(FString::Printf(TEXT("Snapshot of %d keys took %.2f us (reported %.2f us)"),
+			KeysPerDomain * AfterlightCheckpointDomainCount, SnapshotMicroseconds, Checkpoint->GetLastSnapshotMicroseconds()));
+	}
+
+	TestTrue(FString::Printf(TEXT("Fastest snapshot stays under %.0f us"), SnapshotBudgetMicroseconds), BestSnapshotMicroseconds < SnapshotBudgetMicroseconds);
+
+	TestFalse(TEXT("Checkpoint without changes is skipped"), Checkpoint->SaveCheckpoint());
+
+	// Tombstone.
+	Checkpoint->ClearState(EAfterlightCheckpointDomain::Story, MakeKey(0));
+	Checkpoint->SaveCheckpoint();
+
+	// Enough deltas to compact into a base at least once.
+	int32 LastPuzzleValue = 0;
+	for (int32 Step = 0; Step < CompactionInterval + 1; ++Step)
+	{
+		LastPuzzleValue = 5000 + Step;
+		Checkpoint->SetState(EAfterlightCheckpointDomain::Puzzle, MakeKey(1), LastPuzzleValue);
+		Checkpoint->SaveCheckpoint();
+	}
+
+	// One more delta on top of the compacted base.
+	Checkpoint->SetState(EAfterlightCheckpointDomain::Collectible, TEXT("AfterCompaction"), 7);
+	Checkpoint->SaveCheckpoint();
+	Checkpoint->FlushCheckpointWrites();
+
+	const FString SlotDirectory = FPaths::ProjectSavedDir() / TEXT("SaveGames") / SlotName;
+	TArray<FString> BaseFiles;
+	IFileManager::Get().FindFiles(BaseFiles, *(SlotDirectory / TEXT("Base_*.ckpt")), true, false);
+	TestEqual(TEXT("Compaction leaves exactly one base"), BaseFiles.Num(), 1);
+
+	// Scribble over the in-memory state, then round-trip through disk.
+	Checkpoint->SetState(EAfterlightCheckpointDomain::Story, MakeKey(1), -1);
+	TestTrue(TEXT("Slot loads"), Checkpoint->LoadCheckpoint());
+	TestFalse(TEXT("Loading clears unsaved changes"), Checkpoint->HasUnsavedChanges());
+
+	TestFalse(TEXT("Cleared key stays cleared"), Checkpoint->HasState(EAfterlightCheckpointDomain::Story, MakeKey(0)));
+	TestEqual(TEXT("Unsaved change is discarded"), Checkpoint->GetState(EAfterlightCheckpointDomain::Story, MakeKey(1)), MakeValue(0, 1));
+	TestEqual(TEXT("Latest puzzle step survives compaction"), Checkpoint->GetState(EAfterlightCheckpointDomain::Puzzle, MakeKey(1)), LastPuzzleValue);
+	TestEqual(TEXT("Delta after compaction is applied"), Checkpoint->GetState(EAfterlightCheckpointDomain::Collectible, TEXT("AfterCompaction")), 7);
+
+	for (int32 DomainIndex = 0; DomainIndex < AfterlightCheckpointDomainCount; ++DomainIndex)
+	{
+		const EAfterlightCheckpointDomain Domain = static_cast<EAfterlightCheckpointDomain>(DomainIndex);
+		for (int32 Index = 0; Index < KeysPerDomain; ++Index)
+		{
+			// Checked above.
+			const bool bChangedKey = (Domain == EAfterlightCheckpointDomain::Story && Index <= 1)
+				|| (Domain == EAfterlightCheckpointDomain::Puzzle && Index == 1);
+			if (!bChangedKey && Checkpoint->GetState(Domain, MakeKey(Index), INDEX_NONE) != MakeValue(DomainIndex, Index))
+			{
+				AddError(FString::Printf(TEXT("Domain %d key %d did not round-trip"), DomainIndex, Index));
+			}
+		}
+	}
+
+	Checkpoint->ResetProgress();
+	Checkpoint->FlushCheckpointWrites();
+
+	return true;
+}
+
+#endif // WITH_DEV_AUTOMATION_TESTS
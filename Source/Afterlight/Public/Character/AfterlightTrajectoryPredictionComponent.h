@@ -0,0 +1,141 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Components/ActorComponent.h"
+#include "Engine/HitResult.h"
+#include "WorldCollision.h"
+
+#include "AfterlightTrajectoryPredictionComponent.generated.h"
+
+/** Result of one trajectory prediction. */
+USTRUCT(BlueprintType)
+struct AFTERLIGHT_API FAfterlightTrajectoryPrediction
+{
+	GENERATED_BODY()
+
+	/** Arc points from the launch location up to the impact point or the end of the simulated time. */
+	UPROPERTY(BlueprintReadOnly, Category = "Trajectory")
+	TArray<FVector> PathPoints;
+
+	/** Whether the arc hit something before the end of the simulated time. */
+	UPROPERTY(BlueprintReadOnly, Category = "Trajectory")
+	bool bHit = false;
+
+	/** First blocking hit along the arc. Only valid if bHit is set. */
+	UPROPERTY(BlueprintReadOnly, Category = "Trajectory")
+	FHitResult Hit;
+};
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FAfterlightOnTrajectoryPredicted, const FAfterlightTrajectoryPrediction&, Prediction);
+
+/**
+ * Predicts LUMI's aim and throw arc while aiming.
+ *
+ * Every arc segment is submitted as an async trace in one batch, and the results are consumed on the
+ * next tick, so the game thread never waits on collision. The last prediction is cached and a new batch
+ * is only submitted when the aim input or the owner transform moves past the configured tolerances, or
+ * when the cached result gets older than MaxPredictionAge. Use "stat AfterlightTrajectory" to inspect
+ * trace counts and game thread time.
+ */
+UCLASS(ClassGroup = (Afterlight), meta = (BlueprintSpawnableComponent))
+class AFTERLIGHT_API UAfterlightTrajectoryPredictionComponent : public UActorComponent
+{
+	GENERATED_BODY()
+
+public:
+	UAfterlightTrajectoryPredictionComponent();
+
+	//~ UActorComponent interface
+	virtual void TickComponent(float DeltaTime, ELevelTick TickType, FActorComponentTickFunction* ThisTickFunction) override;
+
+	/** Starts or stops predicting. The component only ticks while aiming. */
+	UFUNCTION(BlueprintCallable, Category = "Afterlight|Trajectory")
+	void SetAiming(bool bInAiming);
+
+	UFUNCTION(BlueprintPure, Category = "Afterlight|Trajectory")
+	bool IsAiming() const { return bAiming; }
+
+	/**
+	 * Updates the aim input. Cheap to call every frame; it only stores the values.
+	 *
+	 * @param LaunchLocation	world location the projectile leaves from, e.g. LUMI's hand socket
+	 * @param LaunchVelocity	initial velocity of the projectile in cm/s
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Afterlight|Trajectory")
+	void SetAimInput(const FVector& LaunchLocation, const FVector& LaunchVelocity);
+
+	/** Latest completed prediction. Lags the aim input by one frame. */
+	UFUNCTION(BlueprintPure, Category = "Afterlight|Trajectory")
+	const FAfterlightTrajectoryPrediction& GetPrediction() const { return Prediction; }
+
+	/** Drops the cached prediction so the next tick submits a new batch. */
+	UFUNCTION(BlueprintCallable, Category = "Afterlight|Trajectory")
+	void InvalidatePrediction();
+
+	/** Broadcast whenever a new batch of traces has been consumed. */
+	UPROPERTY(BlueprintAssignable, Category = "Afterlight|Trajectory")
+	FAfterlightOnTrajectoryPredicted OnTrajectoryPredicted;
+
+	/** Number of arc segments, and therefore async traces, per prediction. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Trajectory", meta = (ClampMin = "1", ClampMax = "64"))
+	int32 NumSegments = 16;
+
+	/** Simulated flight time covered by the arc, in seconds. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Trajectory", meta = (ClampMin = "0.05"))
+	float MaxSimTime = 2.f;
+
+	/** Multiplier applied to the world gravity. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Trajectory")
+	float GravityScale = 1.f;
+
+	/** Radius of the thrown object. Zero uses line traces, anything larger uses sphere sweeps. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Trajectory", meta = (ClampMin = "0"))
+	float ProjectileRadius = 0.f;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Trajectory")
+	TEnumAsByte<ECollisionChannel> TraceChannel = ECC_Visibility;
+
+	/** Launch location or owner movement, in cm, that invalidates the cached prediction. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Trajectory|Cache", meta = (ClampMin = "0"))
+	float LocationTolerance = 2.f;
+
+	/** Change in launch direction or owner rotation, in degrees, that invalidates the cached prediction. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Trajectory|Cache", meta = (ClampMin = "0"))
+	float AngleTolerance = 0.5f;
+
+	/** Change in launch speed, in cm/s, that invalidates the cached prediction. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Trajectory|Cache", meta = (ClampMin = "0"))
+	float SpeedTolerance = 5.f;
+
+	/** Age, in seconds, after which the prediction is refreshed anyway so moving geometry is picked up. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Trajectory|Cache", meta = (ClampMin = "0"))
+	float MaxPredictionAge = 0.25f;
+
+private:
+	bool NeedsNewPrediction() const;
+	void SubmitTraces();
+	bool ConsumeTraces();
+
+	/** Aim input as of the latest SetAimInput call. */
+	FVector AimLocation = FVector::ZeroVector;
+	FVector AimVelocity = FVector::ZeroVector;
+
+	/** Aim input and owner transform the cached or pending prediction was built from. */
+	FVector PredictedLocation = FVector::ZeroVector;
+	FVector PredictedVelocity = FVector::ZeroVector;
+	FTransform PredictedOwnerTransform = FTransform::Identity;
+	double PredictedTime = 0.0;
+
+	/** Arc points of the batch in flight; segment i runs from point i to point i + 1. */
+	TArray<FVector> PendingPoints;
+	TArray<FTraceHandle> PendingHandles;
+	uint64 PendingFrame = 0;
+
+	FAfterlightTrajectoryPrediction Prediction;
+
+	bool bAiming = false;
+	bool bHasAimInput = false;
+	bool bPredictionValid = false;
+};
@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineBaseTypes.h"
+#include "Subsystems/WorldSubsystem.h"
+#include "Events/AfterlightEventTypes.h"
+
+#include "AfterlightEventBusSubsystem.generated.h"
+
+DECLARE_DYNAMIC_DELEGATE_OneParam(FAfterlightGameplayEventDelegate, const FAfterlightGameplayEvent&, Event);
+DECLARE_MULTICAST_DELEGATE_OneParam(FAfterlightNativeGameplayEvent, const FAfterlightGameplayEvent&);
+
+/**
+ * Deferred gameplay event bus.
+ *
+ * Publishing copies the event into a preallocated ring buffer of its channel and returns. Every queued
+ * event is dispatched once per frame from a tick function in TG_LastDemotable, after every actor and
+ * component tick group, channel by channel in enum order. Events published while dispatching are
+ * delivered on the next frame. When a channel queue is full new events are dropped and counted. Use
+ * "stat AfterlightEventBus" or GetChannelStats to inspect event counts and dispatch cost. Only game and
+ * PIE worlds get a bus, and it must only be used from the game thread.
+ */
+UCLASS(config = Game)
+class AFTERLIGHT_API UAfterlightEventBusSubsystem : public UWorldSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	//~ UWorldSubsystem interface
+	virtual void PostInitialize() override;
+
+	static void AddReferencedObjects(UObject* InThis, FReferenceCollector& Collector);
+
+	/**
+	 * Queues an event on a channel for dispatch at the end of the frame.
+	 *
+	 * @return false if the channel queue is full and the event was dropped
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Afterlight|Events")
+	bool Publish(EAfterlightEventChannel Channel, const FAfterlightGameplayEvent& Event);
+
+	/** Adds a Blueprint listener to a channel. Binding the same event twice has no effect. */
+	UFUNCTION(BlueprintCallable, Category = "Afterlight|Events")
+	void Subscribe(EAfterlightEventChannel Channel, FAfterlightGameplayEventDelegate Listener);
+
+	UFUNCTION(BlueprintCallable, Category = "Afterlight|Events")
+	void Unsubscribe(EAfterlightEventChannel Channel, FAfterlightGameplayEventDelegate Listener);
+
+	/** Removes every Blueprint listener bound to an object, on every channel. */
+	UFUNCTION(BlueprintCallable, Category = "Afterlight|Events")
+	void UnsubscribeAll(const UObject* ListenerObject);
+
+	UFUNCTION(BlueprintPure, Category = "Afterlight|Events")
+	FAfterlightEventChannelStats GetChannelStats(EAfterlightEventChannel Channel) const;
+
+	UFUNCTION(BlueprintCallable, Category = "Afterlight|Events")
+	void ResetStats();
+
+	/** Native listeners of a channel. They run before Blueprint listeners. */
+	FAfterlightNativeGameplayEvent& OnEvent(EAfterlightEventChannel Channel);
+
+	/** Dispatches everything queued so far. Called from the dispatch tick; exposed for level transitions. */
+	void DispatchPendingEvents();
+
+	/** Queue slots per channel. Rounded up to a power of two. */
+	UPROPERTY(config, EditAnywhere, Category = "Event Bus", meta = (ClampMin = "16"))
+	int32 QueueCapacity = 256;
+
+protected:
+	//~ UWorldSubsystem interface
+	virtual bool DoesSupportWorldType(const EWorldType::Type WorldType) const override;
+
+private:
+	/** Runs DispatchPendingEvents in TG_LastDemotable, also while the game is paused. */
+	struct FDispatchTickFunction : public FTickFunction
+	{
+		UAfterlightEventBusSubsystem* EventBus = nullptr;
+
+		virtual void ExecuteTick(float DeltaTime, ELevelTick TickType, ENamedThreads::Type CurrentThread, const FGraphEventRef& MyCompletionGraphEvent) override;
+		virtual FString DiagnosticMessage() override;
+		virtual FName DiagnosticContext(bool bDetailed) override;
+	};
+
+	struct FChannel
+	{
+		/** Ring buffer storage, sized once in Initialize. */
+		TArray<FAfterlightGameplayEvent> Queue;
+		int32 Head = 0;
+		int32 Num = 0;
+
+		FAfterlightNativeGameplayEvent NativeListeners;
+		TArray<FAfterlightGameplayEventDelegate> BlueprintListeners;
+
+		FAfterlightEventChannelStats Stats;
+		double TotalDispatchMicroseconds = 0.0;
+
+		/** Set when a Blueprint listener was unbound during dispatch and the list needs compacting. */
+		bool bHasStaleListeners = false;
+		bool bWarnedOverflow = false;
+	};
+
+	FChannel& GetChannel(EAfterlightEventChannel Channel);
+	const FChannel& GetChannel(EAfterlightEventChannel Channel) const;
+
+	TStaticArray<FChannel, AfterlightEventChannelCount> Channels;
+
+	FDispatchTickFunction DispatchTickFunction;
+
+	bool bDispatching = false;
+};
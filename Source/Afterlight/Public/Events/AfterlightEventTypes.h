@@ -0,0 +1,94 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GameFramework/Actor.h"
+
+#include "AfterlightEventTypes.generated.h"
+
+/** Typed channels of the gameplay event bus. Each channel has its own queue, listeners and stats. */
+UENUM(BlueprintType)
+enum class EAfterlightEventChannel : uint8
+{
+	/** Player interactions, previously routed through BPI_Interaction. */
+	Interaction,
+	/** Story progress raised by BP_StoryTrigger. */
+	StoryTrigger,
+	/** Puzzle steps, e.g. BP_BoatPuzzle. */
+	PuzzleStep,
+	/** Collectible pickups. */
+	CollectiblePickup,
+	/** Requests for the UI, previously switched on EN_UIType. */
+	UI,
+
+	Count UMETA(Hidden)
+};
+
+constexpr int32 AfterlightEventChannelCount = static_cast<int32>(EAfterlightEventChannel::Count);
+
+/**
+ * One gameplay event. Fixed size so it can be copied into a preallocated queue slot without allocating.
+ * Blueprint enums such as EN_InteractionType, EN_UIType or E_CollectibleItemType travel in Type as a byte.
+ */
+USTRUCT(BlueprintType)
+struct AFTERLIGHT_API FAfterlightGameplayEvent
+{
+	GENERATED_BODY()
+
+	/** Set by the bus when the event is published. */
+	UPROPERTY(BlueprintReadOnly, Category = "Event")
+	EAfterlightEventChannel Channel = EAfterlightEventChannel::Interaction;
+
+	/** Identifies what happened, e.g. a story trigger or puzzle id. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Event")
+	FName EventName;
+
+	/** Actor that caused the event, usually the player character. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Event")
+	TObjectPtr<AActor> Instigator = nullptr;
+
+	/** Actor the event is about, e.g. the interacted object. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Event")
+	TObjectPtr<AActor> Target = nullptr;
+
+	/** Channel-specific type, e.g. an EN_InteractionType value converted to byte. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Event")
+	uint8 Type = 0;
+
+	/** Channel-specific value, e.g. a puzzle step index or pickup count. */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Event")
+	int32 Value = 0;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Event")
+	FVector Location = FVector::ZeroVector;
+};
+
+/** Counters and dispatch cost of one channel. */
+USTRUCT(BlueprintType)
+struct AFTERLIGHT_API FAfterlightEventChannelStats
+{
+	GENERATED_BODY()
+
+	UPROPERTY(BlueprintReadOnly, Category = "Event Bus")
+	int32 Published = 0;
+
+	UPROPERTY(BlueprintReadOnly, Category = "Event Bus")
+	int32 Dispatched = 0;
+
+	/** Events rejected because the channel queue was full. */
+	UPROPERTY(BlueprintReadOnly, Category = "Event Bus")
+	int32 Dropped = 0;
+
+	/** Largest number of events queued on the channel at once. */
+	UPROPERTY(BlueprintReadOnly, Category = "Event Bus")
+	int32 PeakQueueDepth = 0;
+
+	/** Time spent dispatching the channel in the latest frame, in microseconds. */
+	UPROPERTY(BlueprintReadOnly, Category = "Event Bus")
+	float LastDispatchMicroseconds = 0.f;
+
+	/** Time spent dispatching the channel since the stats were reset, in microseconds. */
+	UPROPERTY(BlueprintReadOnly, Category = "Event Bus")
+	float TotalDispatchMicroseconds = 0.f;
+};
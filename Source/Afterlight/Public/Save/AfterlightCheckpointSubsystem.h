@@ -0,0 +1,116 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Subsystems/GameInstanceSubsystem.h"
+#include "Save/AfterlightCheckpointTypes.h"
+
+#include "AfterlightCheckpointSubsystem.generated.h"
+
+class FAfterlightCheckpointWriter;
+
+/**
+ * Native checkpoint storage for story, puzzle, collectible and world object state.
+ *
+ * Gameplay Blueprints write small key/value pairs into a domain. Each domain remembers which keys
+ * changed since the last checkpoint, and SaveCheckpoint only copies those keys before handing them to a
+ * background writer, so the game thread cost scales with the number of changes rather than the size
+ * of the save. Use "stat AfterlightCheckpoint" to inspect snapshot and write costs.
+ */
+UCLASS(config = Game)
+class AFTERLIGHT_API UAfterlightCheckpointSubsystem : public UGameInstanceSubsystem
+{
+	GENERATED_BODY()
+
+public:
+	//~ USubsystem interface
+	virtual void Initialize(FSubsystemCollectionBase& Collection) override;
+	virtual void Deinitialize() override;
+
+	/** Sets a key in a domain. Writing the value it already has does not dirty the domain. */
+	UFUNCTION(BlueprintCallable, Category = "Afterlight|Checkpoint")
+	void SetState(EAfterlightCheckpointDomain Domain, FName Key, int32 Value);
+
+	/** Removes a key from a domain. */
+	UFUNCTION(BlueprintCallable, Category = "Afterlight|Checkpoint")
+	void ClearState(EAfterlightCheckpointDomain Domain, FName Key);
+
+	UFUNCTION(BlueprintPure, Category = "Afterlight|Checkpoint")
+	int32 GetState(EAfterlightCheckpointDomain Domain, FName Key, int32 DefaultValue = 0) const;
+
+	UFUNCTION(BlueprintPure, Category = "Afterlight|Checkpoint")
+	bool HasState(EAfterlightCheckpointDomain Domain, FName Key) const;
+
+	/**
+	 * Snapshots every dirty key and queues it as a delta for the background writer.
+	 *
+	 * @return false if nothing changed since the last checkpoint
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Afterlight|Checkpoint")
+	bool SaveCheckpoint();
+
+	/**
+	 * Waits for pending writes, then replaces the in-memory state with the slot on disk.
+	 *
+	 * @return false if the slot is empty or unreadable
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Afterlight|Checkpoint")
+	bool LoadCheckpoint();
+
+	/**
+	 * Waits for pending writes to the current slot, then switches to another slot and loads it.
+	 *
+	 * @return false if the new slot is empty or unreadable
+	 */
+	UFUNCTION(BlueprintCallable, Category = "Afterlight|Checkpoint")
+	bool OpenSlot(const FString& InSlotName);
+
+	/** Clears every domain and deletes the slot on disk, for starting a new game. */
+	UFUNCTION(BlueprintCallable, Category = "Afterlight|Checkpoint")
+	void ResetProgress();
+
+	/** Blocks until every queued checkpoint is on disk. */
+	UFUNCTION(BlueprintCallable, Category = "Afterlight|Checkpoint")
+	void FlushCheckpointWrites();
+
+	UFUNCTION(BlueprintPure, Category = "Afterlight|Checkpoint")
+	bool HasUnsavedChanges() const;
+
+	UFUNCTION(BlueprintPure, Category = "Afterlight|Checkpoint")
+	bool IsWriteInProgress() const;
+
+	/** Game thread time spent by the last SaveCheckpoint call, in microseconds. */
+	UFUNCTION(BlueprintPure, Category = "Afterlight|Checkpoint")
+	float GetLastSnapshotMicroseconds() const { return LastSnapshotMicroseconds; }
+
+	/** Name of the directory under Saved/SaveGames that holds the slot. */
+	UPROPERTY(config, EditAnywhere, Category = "Checkpoint")
+	FString SlotName = TEXT("Checkpoint");
+
+	/** Number of deltas written before they are folded into a new base file. */
+	UPROPERTY(config, EditAnywhere, Category = "Checkpoint", meta = (ClampMin = "1"))
+	int32 CompactionInterval = 16;
+
+	/** Whether the slot is loaded automatically when the game instance starts. */
+	UPROPERTY(config, EditAnywhere, Category = "Checkpoint")
+	bool bLoadOnInitialize = true;
+
+private:
+	struct FDomainState
+	{
+		TMap<FName, int32> Values;
+		TSet<FName> DirtyKeys;
+	};
+
+	FString GetSlotDirectory() const;
+
+	FDomainState& GetDomain(EAfterlightCheckpointDomain Domain);
+	const FDomainState& GetDomain(EAfterlightCheckpointDomain Domain) const;
+
+	TStaticArray<FDomainState, AfterlightCheckpointDomainCount> Domains;
+
+	TSharedPtr<FAfterlightCheckpointWriter> Writer;
+
+	float LastSnapshotMicroseconds = 0.f;
+};
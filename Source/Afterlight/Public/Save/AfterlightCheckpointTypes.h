@@ -0,0 +1,40 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+#include "AfterlightCheckpointTypes.generated.h"
+
+/**
+ * Gameplay systems that own persistent checkpoint state.
+ * Each domain tracks its own dirty keys so a checkpoint only writes what changed.
+ */
+UENUM(BlueprintType)
+enum class EAfterlightCheckpointDomain : uint8
+{
+	/** Story progress flags raised by BP_StoryTrigger. */
+	Story,
+	/** Puzzle steps, e.g. BP_BoatPuzzle. */
+	Puzzle,
+	/** Collected items, keyed by E_CollectibleItemType or item id. */
+	Collectible,
+	/** Broken or opened world objects such as BP_HiddenDoor. */
+	WorldObject,
+
+	Count UMETA(Hidden)
+};
+
+constexpr int32 AfterlightCheckpointDomainCount = static_cast<int32>(EAfterlightCheckpointDomain::Count);
+
+/** One changed key inside a delta. Removed keys are written as tombstones. */
+struct FAfterlightCheckpointRecord
+{
+	FName Key;
+	int32 Value = 0;
+	EAfterlightCheckpointDomain Domain = EAfterlightCheckpointDomain::Story;
+	bool bRemoved = false;
+};
+
+/** Full key/value state of every domain. */
+using FAfterlightCheckpointState = TStaticArray<TMap<FName, int32>, AfterlightCheckpointDomainCount>;
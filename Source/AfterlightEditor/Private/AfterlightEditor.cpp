@@ -0,0 +1,8 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "AfterlightEditor.h"
+#include "Modules/ModuleManager.h"
+
+DEFINE_LOG_CATEGORY(LogAfterlightEditor);
+
+IMPLEMENT_MODULE(FDefaultModuleImpl, AfterlightEditor);
@@ -0,0 +1,486 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#include "Commandlets/AfterlightContentAuditCommandlet.h"
+#include "AfterlightEditor.h"
+#include "Algo/Count.h"
+#include "Algo/Sort.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "AssetRegistry/AssetRegistryState.h"
+#include "AssetRegistry/IAssetRegistry.h"
+#include "Async/ParallelFor.h"
+#include "Engine/Level.h"
+#include "Engine/World.h"
+#include "ExternalPackageHelper.h"
+#include "GameMapsSettings.h"
+#include "HAL/PlatformTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "Settings/ProjectPackagingSettings.h"
+
+namespace AfterlightContentAudit
+{
+	static const FString GameRoot = TEXT("/Game");
+
+	struct FPackageAudit
+	{
+		FName PackageName;
+		FAssetData PrimaryAsset;
+		int64 DiskBytes = 0;
+		int64 CookedBytes = 0;
+		int64 MemoryBytes = 0;
+		bool bCookedSizeKnown = false;
+		bool bReachable = false;
+		bool bOversized = false;
+		bool bIsMap = false;
+	};
+
+	/** True for packages and folders under __ExternalActors__ or __ExternalObjects__. */
+	static bool IsExternalPackagePath(const FString& Path)
+	{
+		return Path.Contains(TEXT("/__External"));
+	}
+
+	static double BytesToMB(int64 Bytes)
+	{
+		return static_cast<double>(Bytes) / (1024.0 * 1024.0);
+	}
+
+	/** Bytes per pixel for the pixel format names used by texture asset registry tags. */
+	static double GetBytesPerPixel(const FString& Format)
+	{
+		if (Format == TEXT("DXT1") || Format == TEXT("BC4") || Format == TEXT("ETC2_RGB"))
+		{
+			return 0.5;
+		}
+		if (Format.StartsWith(TEXT("DXT")) || Format.StartsWith(TEXT("BC")) || Format.StartsWith(TEXT("ASTC")) || Format == TEXT("G8"))
+		{
+			return 1.0;
+		}
+		if (Format == TEXT("FloatRGBA") || Format == TEXT("R16G16B16A16_UNORM"))
+		{
+			return 8.0;
+		}
+		if (Format == TEXT("A32B32G32R32F"))
+		{
+			return 16.0;
+		}
+		return 4.0;
+	}
+
+	/**
+	 * Estimates resident memory from asset registry tags, without loading the asset. Textures assume the
+	 * full mip chain is resident and meshes assume a typical vertex layout, so the result is an upper bound
+	 * meant for ranking. Anything without size tags falls back to its package size.
+	 */
+	static int64 EstimateRuntimeMemory(const FAssetData& AssetData, int64 DiskBytes)
+	{
+		static const FName NAME_Dimensions(TEXT("Dimensions"));
+		static const FName NAME_Format(TEXT("Format"));
+		static const FName NAME_Vertices(TEXT("Vertices"));
+		static const FName NAME_Triangles(TEXT("Triangles"));
+
+		FString Dimensions;
+		if (AssetData.GetTagValue(NAME_Dimensions, Dimensions))
+		{
+			TArray<FString> Axes;
+			Dimensions.ParseIntoArray(Axes, TEXT("x"));
+
+			int64 Pixels = 1;
+			for (const FString& Axis : Axes)
+			{
+				Pixels *= FMath::Max(1, FCString::Atoi(*Axis));
+			}
+
+			FString Format;
+			AssetData.GetTagValue(NAME_Format, Format);
+
+			// A full mip chain adds a third on top of the top mip.
+			return static_cast<int64>(Pixels * GetBytesPerPixel(Format) * 4.0 / 3.0);
+		}
+
+		int32 Vertices = 0;
+		int32 Triangles = 0;
+		const bool bHasVertices = AssetData.GetTagValue(NAME_Vertices, Vertices);
+		const bool bHasTriangles = AssetData.GetTagValue(NAME_Triangles, Triangles);
+		if (bHasVertices || bHasTriangles)
+		{
+			// Position, tangent basis, two UV channels and colour, plus 32-bit indices.
+			return static_cast<int64>(Vertices) * 48 + static_cast<int64>(Triangles) * 3 * 4;
+		}
+
+		return DiskBytes;
+	}
+
+	/** Adds every package under a long package path to Roots. */
+	static void AddDirectoryRoots(IAssetRegistry& AssetRegistry, const FString& Path, TArray<FName>& Roots)
+	{
+		TArray<FAssetData> Assets;
+		AssetRegistry.GetAssetsByPath(FName(*Path), Assets, true);
+		for (const FAssetData& Asset : Assets)
+		{
+			Roots.AddUnique(Asset.PackageName);
+		}
+	}
+
+	/**
+	 * Adds the One File Per Actor packages of a map: its external actors and external objects. The map
+	 * has no asset registry dependency on them, so the walk would never reach them otherwise.
+	 */
+	static void AddExternalPackages(IAssetRegistry& AssetRegistry, FName MapPackageName, TArray<FName>& OutPackages)
+	{
+		const FString MapPath = MapPackageName.ToString();
+		AddDirectoryRoots(AssetRegistry, ULevel::GetExternalActorsPath(MapPath), OutPackages);
+		AddDirectoryRoots(AssetRegistry, FExternalPackageHelper::GetExternalObjectsPath(MapPath), OutPackages);
+	}
+}
+
+UAfterlightContentAuditCommandlet::UAfterlightContentAuditCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+}
+
+int32 UAfterlightContentAuditCommandlet::Main(const FString& Params)
+{
+	using namespace AfterlightContentAudit;
+
+	const double StartTime = FPlatformTime::Seconds();
+
+	FString MapsParam;
+	if (FParse::Value(*Params, TEXT("Maps="), MapsParam))
+	{
+		RootMaps.Reset();
+		MapsParam.ParseIntoArray(RootMaps, TEXT("+"));
+	}
+
+	FString CookedRegistryPath;
+	FParse::Value(*Params, TEXT("CookedRegistry="), CookedRegistryPath);
+
+	FString OutputDir = FPaths::ProjectSavedDir() / TEXT("Audit");
+	FParse::Value(*Params, TEXT("Output="), OutputDir);
+
+	FParse::Value(*Params, TEXT("OversizedDiskMB="), OversizedDiskMB);
+	FParse::Value(*Params, TEXT("OversizedMemoryMB="), OversizedMemoryMB);
+
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(TEXT("AssetRegistry")).Get();
+	AssetRegistry.SearchAllAssets(true);
+
+	// Gather every package under /Game.
+	TArray<FPackageAudit> Packages;
+	TMap<FName, int32> PackageIndices;
+	{
+		TArray<FAssetData> Assets;
+		AssetRegistry.GetAssetsByPath(FName(*GameRoot), Assets, true);
+
+		for (FAssetData& Asset : Assets)
+		{
+			int32& Index = PackageIndices.FindOrAdd(Asset.PackageName, INDEX_NONE);
+			if (Index == INDEX_NONE)
+			{
+				Index = Packages.AddDefaulted();
+				Packages[Index].PackageName = Asset.PackageName;
+				Packages[Index].PrimaryAsset = MoveTemp(Asset);
+			}
+			else if (Asset.AssetName == FName(FPackageName::GetShortName(Asset.PackageName)))
+			{
+				// Prefer the asset named after its package, e.g. the UWorld over its BuiltData.
+				Packages[Index].PrimaryAsset = MoveTemp(Asset);
+			}
+		}
+
+		const FTopLevelAssetPath WorldClassPath = UWorld::StaticClass()->GetClassPathName();
+		for (FPackageAudit& Package : Packages)
+		{
+			Package.bIsMap = Package.PrimaryAsset.AssetClassPath == WorldClassPath;
+		}
+	}
+
+	// Collect the roots: configured maps and packages, the project default map and game mode,
+	// and everything the packaging settings always cook.
+	TArray<FName> Roots;
+	{
+		TArray<FString> RootPaths = RootMaps;
+		RootPaths.Append(RootPackages);
+		RootPaths.Add(UGameMapsSettings::GetGameDefaultMap());
+		RootPaths.Add(UGameMapsSettings::GetGlobalDefaultGameMode());
+
+		const UProjectPackagingSettings* PackagingSettings = GetDefault<UProjectPackagingSettings>();
+		for (const FFilePath& MapToCook : PackagingSettings->MapsToCook)
+		{
+			RootPaths.Add(MapToCook.FilePath);
+		}
+
+		for (const FString& RootPath : RootPaths)
+		{
+			if (RootPath.IsEmpty())
+			{
+				continue;
+			}
+
+			const FName PackageName(FPackageName::ObjectPathToPackageName(RootPath));
+			if (PackageIndices.Contains(PackageName))
+			{
+				Roots.AddUnique(PackageName);
+			}
+			else
+			{
+				UE_LOG(LogAfterlightEditor, Warning, TEXT("Root '%s' is not a /Game package, skipping"), *RootPath);
+			}
+		}
+
+		for (const FDirectoryPath& Directory : PackagingSettings->DirectoriesToAlwaysCook)
+		{
+			AddDirectoryRoots(AssetRegistry, Directory.Path, Roots);
+		}
+	}
+
+	if (Roots.Num() == 0)
+	{
+		UE_LOG(LogAfterlightEditor, Error, TEXT("No root packages found. Configure RootMaps or pass -Maps="));
+		return 1;
+	}
+
+	// Walk game dependencies one level at a time. Registry queries for a level run in parallel;
+	// merging into the visited set is serial. Maps also reach their external actor and object packages.
+	// Packages outside /Game, e.g. engine or plugin content, are walked through but not audited, since
+	// /Game content can be reachable only through them.
+	{
+		TSet<FName> Visited(Roots);
+		TArray<FName> Frontier = Roots;
+		for (const FName& Root : Roots)
+		{
+			if (const int32* Index = PackageIndices.Find(Root))
+			{
+				Packages[*Index].bReachable = true;
+			}
+		}
+
+		const UE::AssetRegistry::FDependencyQuery GameQuery(UE::AssetRegistry::EDependencyQuery::Game);
+
+		TArray<TArray<FName>> FrontierDependencies;
+		while (Frontier.Num() > 0)
+		{
+			FrontierDependencies.SetNum(Frontier.Num());
+			ParallelFor(Frontier.Num(), [&](int32 Index)
+			{
+				FrontierDependencies[Index].Reset();
+				AssetRegistry.GetDependencies(Frontier[Index], FrontierDependencies[Index], UE::AssetRegistry::EDependencyCategory::Package, GameQuery);
+
+				const int32* PackageIndex = PackageIndices.Find(Frontier[Index]);
+				if (PackageIndex && Packages[*PackageIndex].bIsMap)
+				{
+					AddExternalPackages(AssetRegistry, Frontier[Index], FrontierDependencies[Index]);
+				}
+			});
+
+			TArray<FName> NextFrontier;
+			for (const TArray<FName>& Dependencies : FrontierDependencies)
+			{
+				for (const FName& Dependency : Dependencies)
+				{
+					// Native script packages have no registry dependencies to follow.
+					if (FPackageName::IsScriptPackage(Dependency.ToString()))
+					{
+						continue;
+					}
+
+					bool bAlreadyVisited = false;
+					Visited.Add(Dependency, &bAlreadyVisited);
+					if (bAlreadyVisited)
+					{
+						continue;
+					}
+
+					if (const int32* Index = PackageIndices.Find(Dependency))
+					{
+						Packages[*Index].bReachable = true;
+					}
+					NextFrontier.Add(Dependency);
+				}
+			}
+
+			Frontier = MoveTemp(NextFrontier);
+		}
+	}
+
+	// Size every package in parallel.
+	{
+		FAssetRegistryState CookedState;
+		bool bHasCookedState = false;
+		if (!CookedRegistryPath.IsEmpty())
+		{
+			bHasCookedState = FAssetRegistryState::LoadFromDisk(*CookedRegistryPath, FAssetRegistryLoadOptions(), CookedState);
+			if (!bHasCookedState)
+			{
+				UE_LOG(LogAfterlightEditor, Warning, TEXT("Failed to load cooked asset registry '%s'; cooked sizes will be estimated"), *CookedRegistryPath);
+			}
+		}
+
+		const int64 OversizedDiskBytes = static_cast<int64>(OversizedDiskMB * 1024.0 * 1024.0);
+		const int64 OversizedMemoryBytes = static_cast<int64>(OversizedMemoryMB * 1024.0 * 1024.0);
+
+		ParallelFor(Packages.Num(), [&](int32 Index)
+		{
+			FPackageAudit& Package = Packages[Index];
+
+			if (TOptional<FAssetPackageData> PackageData = AssetRegistry.GetAssetPackageDataCopy(Package.PackageName))
+			{
+				Package.DiskBytes = FMath::Max<int64>(0, PackageData->DiskSize);
+			}
+
+			if (const FAssetPackageData* CookedData = bHasCookedState ? CookedState.GetAssetPackageData(Package.PackageName) : nullptr)
+			{
+				Package.CookedBytes = FMath::Max<int64>(0, CookedData->DiskSize);
+				Package.bCookedSizeKnown = true;
+			}
+			else
+			{
+				Package.CookedBytes = Package.DiskBytes;
+			}
+
+			Package.MemoryBytes = EstimateRuntimeMemory(Package.PrimaryAsset, Package.DiskBytes);
+			Package.bOversized = Package.DiskBytes > OversizedDiskBytes || Package.MemoryBytes > OversizedMemoryBytes;
+		});
+	}
+
+	// Report unreachable and oversized packages, largest first within each group.
+	TArray<const FPackageAudit*> Flagged;
+	for (const FPackageAudit& Package : Packages)
+	{
+		if (!Package.bReachable || Package.bOversized)
+		{
+			Flagged.Add(&Package);
+		}
+	}
+
+	Algo::Sort(Flagged, [](const FPackageAudit* A, const FPackageAudit* B)
+	{
+		if (A->bReachable != B->bReachable)
+		{
+			return !A->bReachable;
+		}
+		return A->CookedBytes > B->CookedBytes;
+	});
+
+	FString Report = TEXT("Package,Class,Status,DiskBytes,CookedBytes,CookedSizeEstimated,EstimatedMemoryBytes\n");
+	for (const FPackageAudit* Package : Flagged)
+	{
+		const TCHAR* Status = !Package->bReachable
+			? (Package->bOversized ? TEXT("Unreachable+Oversized") : TEXT("Unreachable"))
+			: TEXT("Oversized");
+
+		Report += FString::Printf(TEXT("%s,%s,%s,%lld,%lld,%s,%lld\n"),
+			*Package->PackageName.ToString(),
+			*Package->PrimaryAsset.AssetClassPath.GetAssetName().ToString(),
+			Status,
+			Package->DiskBytes,
+			Package->CookedBytes,
+			Package->bCookedSizeKnown ? TEXT("false") : TEXT("true"),
+			Package->MemoryBytes);
+	}
+
+	// A folder can be excluded from cooking when nothing below it is reachable. Exclude the highest such
+	// folder under /Game; unreachable packages directly in a folder that also holds reachable ones are
+	// listed for manual review instead. External actor and object folders are never excluded: they cook
+	// with their map, and excluding them would strip actors from maps that are cooked.
+	TMap<FString, bool> FolderHasReachable;
+	for (const FPackageAudit& Package : Packages)
+	{
+		FString Folder = FPackageName::GetLongPackagePath(Package.PackageName.ToString());
+		while (Folder.Len() > GameRoot.Len())
+		{
+			bool& bHasReachable = FolderHasReachable.FindOrAdd(Folder, false);
+			bHasReachable |= Package.bReachable;
+			Folder = FPackageName::GetLongPackagePath(Folder);
+		}
+	}
+
+	TSet<FString> ExcludedFolders;
+	TArray<FName> ReviewPackages;
+	TMap<FString, int64> CookedBytesByPack;
+	for (const FPackageAudit& Package : Packages)
+	{
+		if (Package.bReachable)
+		{
+			continue;
+		}
+
+		if (!IsExternalPackagePath(Package.PackageName.ToString()))
+		{
+			FString ExcludedFolder;
+			FString Folder = FPackageName::GetLongPackagePath(Package.PackageName.ToString());
+			while (Folder.Len() > GameRoot.Len() && !FolderHasReachable.FindRef(Folder))
+			{
+				ExcludedFolder = Folder;
+				Folder = FPackageName::GetLongPackagePath(Folder);
+			}
+
+			if (ExcludedFolder.IsEmpty())
+			{
+				ReviewPackages.Add(Package.PackageName);
+			}
+			else
+			{
+				ExcludedFolders.Add(ExcludedFolder);
+			}
+		}
+
+		// Totals per top-level folder, which is one marketplace pack each.
+		FString Pack;
+		if (!Package.PackageName.ToString().RightChop(GameRoot.Len() + 1).Split(TEXT("/"), &Pack, nullptr))
+		{
+			Pack = TEXT("(Game root)");
+		}
+		CookedBytesByPack.FindOrAdd(Pack) += Package.CookedBytes;
+	}
+
+	TArray<FString> SortedFolders = ExcludedFolders.Array();
+	SortedFolders.Sort();
+
+	FString Exclusions = TEXT("; Generated by AfterlightContentAudit. Review, then merge into Config/DefaultGame.ini.\n");
+	Exclusions += TEXT("[/Script/UnrealEd.ProjectPackagingSettings]\n");
+	for (const FString& Folder : SortedFolders)
+	{
+		Exclusions += FString::Printf(TEXT("+DirectoriesToNeverCook=(Path=\"%s\")\n"), *Folder);
+	}
+
+	FString Review;
+	for (const FName& PackageName : ReviewPackages)
+	{
+		Review += PackageName.ToString() + TEXT("\n");
+	}
+
+	const FString ReportPath = OutputDir / TEXT("ContentAudit.csv");
+	const FString ExclusionsPath = OutputDir / TEXT("CookExclusions.ini");
+	const FString ReviewPath = OutputDir / TEXT("UnreachableInSharedFolders.txt");
+	if (!FFileHelper::SaveStringToFile(Report, *ReportPath)
+		|| !FFileHelper::SaveStringToFile(Exclusions, *ExclusionsPath)
+		|| !FFileHelper::SaveStringToFile(Review, *ReviewPath))
+	{
+		UE_LOG(LogAfterlightEditor, Error, TEXT("Failed to write audit output to '%s'"), *OutputDir);
+		return 1;
+	}
+
+	TArray<TPair<FString, int64>> PackTotals = CookedBytesByPack.Array();
+	Algo::Sort(PackTotals, [](const TPair<FString, int64>& A, const TPair<FString, int64>& B) { return A.Value > B.Value; });
+
+	int64 UnreachableBytes = 0;
+	UE_LOG(LogAfterlightEditor, Display, TEXT("Unreachable cooked size per folder:"));
+	for (const TPair<FString, int64>& PackTotal : PackTotals)
+	{
+		UE_LOG(LogAfterlightEditor, Display, TEXT("  %-32s %10.1f MB"), *PackTotal.Key, BytesToMB(PackTotal.Value));
+		UnreachableBytes += PackTotal.Value;
+	}
+
+	const int32 NumReachable = Algo::CountIf(Packages, [](const FPackageAudit& Package) { return Package.bReachable; });
+	UE_LOG(LogAfterlightEditor, Display, TEXT("Audited %d packages from %d roots in %.1fs: %d reachable, %d unreachable (%.1f MB), %d folders excluded, %d packages need review"),
+		Packages.Num(), Roots.Num(), FPlatformTime::Seconds() - StartTime,
+		NumReachable, Packages.Num() - NumReachable, BytesToMB(UnreachableBytes),
+		SortedFolders.Num(), ReviewPackages.Num());
+	UE_LOG(LogAfterlightEditor, Display, TEXT("Wrote %s, %s and %s"), *ReportPath, *ExclusionsPath, *ReviewPath);
+
+	return 0;
+}
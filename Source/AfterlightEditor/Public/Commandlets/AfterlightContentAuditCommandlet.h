@@ -0,0 +1,48 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+
+#include "AfterlightContentAuditCommandlet.generated.h"
+
+/**
+ * Walks the asset registry from the gameplay maps and reports content that is never reached, or that is
+ * larger than the configured budgets, with its disk, cooked and estimated runtime memory cost. Also writes
+ * a DirectoriesToNeverCook list for every /Game folder that nothing reachable lives in.
+ *
+ * Usage:
+ *   UnrealEditor-Cmd.exe Afterlight.uproject -run=AfterlightContentAudit
+ *       [-Maps=/Game/Levels/A+/Game/Levels/B] [-CookedRegistry=<path to DevelopmentAssetRegistry.bin>]
+ *       [-Output=<dir>] [-OversizedDiskMB=<n>] [-OversizedMemoryMB=<n>]
+ *
+ * Without -CookedRegistry the cooked size is estimated from the uncooked package size.
+ */
+UCLASS(config = Editor)
+class UAfterlightContentAuditCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UAfterlightContentAuditCommandlet();
+
+	//~ UCommandlet interface
+	virtual int32 Main(const FString& Params) override;
+
+	/** Gameplay maps the walk starts from, as long package names. The project default map is always added. */
+	UPROPERTY(config)
+	TArray<FString> RootMaps;
+
+	/** Extra non-map packages the walk starts from, e.g. assets only loaded by path. */
+	UPROPERTY(config)
+	TArray<FString> RootPackages;
+
+	/** Packages larger than this on disk are reported as oversized. */
+	UPROPERTY(config)
+	float OversizedDiskMB = 16.f;
+
+	/** Packages estimated to use more than this at runtime are reported as oversized. */
+	UPROPERTY(config)
+	float OversizedMemoryMB = 32.f;
+};